@@ -0,0 +1,361 @@
+// Copyright (c) 2011 Andrew Aldridge under the terms in the LICENSE file.
+
+// Benchmarks the database in the current directory, optionally building it
+// first, and prints the results as a JSON object.  Lookups use a fixed
+// random seed, so two builds are measured on the same titles.  Lookup
+// throughput is also measured with several threads sharing one reader.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "database.h"
+#include "quelt-common.h"
+
+// Titles looked up over and over in the hot set
+#define HOT_TITLES 64
+// Length of the substrings of titles searched for
+#define NEEDLE_LEN 5
+
+typedef struct {
+    char** titles;
+    size_t n_titles;
+    size_t cap;
+} TitleList;
+
+// One thread's share of a threaded lookup run
+typedef struct {
+    QueltDB* db;
+    char** titles;
+    size_t n;
+    size_t found;
+    uint64_t bytes;
+} LookupWorker;
+
+static void collect_title(void* ctx, char* title, size_t len) {
+    TitleList* list = ctx;
+    if(list->n_titles == list->cap) {
+        list->cap = (list->cap == 0)? 1024 : list->cap*2;
+        list->titles = realloc(list->titles, list->cap*sizeof(char*));
+        if(!list->titles) {
+            fail(RETURN_BADFILE, "Out of memory");
+        }
+    }
+
+    const size_t title_len = strnlen(title, len);
+    char* copy = malloc(title_len + 1);
+    if(!copy) {
+        fail(RETURN_BADFILE, "Out of memory");
+    }
+    memcpy(copy, title, title_len);
+    copy[title_len] = '\0';
+    list->titles[list->n_titles] = copy;
+    list->n_titles += 1;
+}
+
+static void count_bytes(void* ctx, char* chunk, size_t len) {
+    *(uint64_t*)ctx += len;
+}
+
+static void count_match(void* ctx, char* title, size_t len) {
+    *(uint64_t*)ctx += 1;
+}
+
+// xorshift64*, seeded identically on every run
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+static int double_cmp(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, size_t n, double p) {
+    return sorted[(size_t)(p * (n - 1))];
+}
+
+// Time getarticle on each title in turn, and print the latency percentiles
+// in microseconds
+static void bench_lookups(QueltDB* db, const char* name, char** titles, size_t n,
+                          bool last) {
+    double* latencies = malloc(n * sizeof(double));
+    if(!latencies) {
+        fail(RETURN_BADFILE, "Out of memory");
+    }
+
+    uint64_t bytes = 0;
+    size_t found = 0;
+    double total = 0;
+    for(size_t i = 0; i < n; i += 1) {
+        const double start = monotonic_seconds();
+        found += (queltdb_getarticle(db, titles[i], count_bytes, &bytes) > 0);
+        latencies[i] = (monotonic_seconds() - start) * 1e6;
+        total += latencies[i];
+    }
+
+    qsort(latencies, n, sizeof(double), double_cmp);
+    printf("    \"%s\": {\"lookups\": %zu, \"found\": %zu, \"bytes\": %llu, "
+           "\"mean_us\": %.1f, \"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, "
+           "\"max_us\": %.1f}%s\n",
+           name, n, found, (unsigned long long)bytes, total / n,
+           percentile(latencies, n, 0.5), percentile(latencies, n, 0.9),
+           percentile(latencies, n, 0.99), latencies[n-1], last? "" : ",");
+    free(latencies);
+}
+
+static void* lookup_worker(void* arg) {
+    LookupWorker* worker = arg;
+    for(size_t i = 0; i < worker->n; i += 1) {
+        worker->found += (queltdb_getarticle(worker->db, worker->titles[i], count_bytes,
+                                             &worker->bytes) > 0);
+    }
+
+    return NULL;
+}
+
+// Time getarticle on each title with the titles split between n_threads
+// threads sharing db, and print the lookups per second
+static void bench_threads(QueltDB* db, char** titles, size_t n, int n_threads, bool last) {
+    LookupWorker* workers = calloc(n_threads, sizeof(LookupWorker));
+    pthread_t* threads = calloc(n_threads, sizeof(pthread_t));
+    if(!workers || !threads) {
+        fail(RETURN_BADFILE, "Out of memory");
+    }
+
+    for(int i = 0; i < n_threads; i += 1) {
+        const size_t first = n * i / n_threads;
+        workers[i].db = db;
+        workers[i].titles = titles + first;
+        workers[i].n = n * (i + 1) / n_threads - first;
+    }
+
+    const double start = monotonic_seconds();
+    for(int i = 0; i < n_threads; i += 1) {
+        if(pthread_create(&threads[i], NULL, lookup_worker, &workers[i]) != 0) {
+            fail(RETURN_BADFILE, "Could not start thread");
+        }
+    }
+    size_t found = 0;
+    uint64_t bytes = 0;
+    for(int i = 0; i < n_threads; i += 1) {
+        pthread_join(threads[i], NULL);
+        found += workers[i].found;
+        bytes += workers[i].bytes;
+    }
+    const double elapsed = monotonic_seconds() - start;
+
+    printf("    \"%d\": {\"lookups\": %zu, \"found\": %zu, \"bytes\": %llu, "
+           "\"seconds\": %.3f, \"per_second\": %.1f}%s\n",
+           n_threads, n, found, (unsigned long long)bytes, elapsed, n / elapsed,
+           last? "" : ",");
+    free(workers);
+    free(threads);
+}
+
+// Time n searches for substrings of random titles
+static void bench_searches(QueltDB* db, const TitleList* list, size_t n, int flags,
+                           uint64_t* state, const char* name, bool last) {
+    uint64_t matches = 0;
+    double total = 0;
+    for(size_t i = 0; i < n; i += 1) {
+        const char* title = list->titles[next_random(state) % list->n_titles];
+        const size_t len = strlen(title);
+        char needle[NEEDLE_LEN+1];
+        const size_t start_pos = (len > NEEDLE_LEN)? next_random(state) % (len - NEEDLE_LEN) : 0;
+        snprintf(needle, sizeof(needle), "%s", title + start_pos);
+
+        const double start = monotonic_seconds();
+        queltdb_search_flags(db, needle, flags, count_match, &matches);
+        total += monotonic_seconds() - start;
+    }
+
+    printf("    \"%s\": {\"searches\": %zu, \"matches\": %llu, \"mean_us\": %.1f, "
+           "\"per_second\": %.1f}%s\n",
+           name, n, (unsigned long long)matches, total / n * 1e6, n / total, last? "" : ",");
+}
+
+static long long file_size(const char* path) {
+    struct stat st;
+    return (stat(path, &st) == 0)? (long long)st.st_size : 0;
+}
+
+// Pull one of the counters quelt-split printed with --stats, or return -1
+static double split_stat(const char* stats, const char* name) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\": ", name);
+    const char* pos = stats? strstr(stats, key) : NULL;
+    return pos? strtod(pos + strlen(key), NULL) : -1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: bench [--split QUELT-SPLIT DUMP] [--lookups N] [--searches N]\n"
+                    "             [--threads N] [--build LABEL]\n");
+    exit(RETURN_BADARGS);
+}
+
+int main(int argc, char** argv) {
+    const char* split_path = NULL;
+    const char* dump_path = NULL;
+    const char* build = "";
+    size_t n_lookups = 20000;
+    size_t n_searches = 200;
+    int max_threads = 8;
+
+    for(int i = 1; i < argc; i += 1) {
+        if(strcmp(argv[i], "--split") == 0 && i + 2 < argc) {
+            split_path = argv[i+1];
+            dump_path = argv[i+2];
+            i += 2;
+        }
+        else if(strcmp(argv[i], "--lookups") == 0 && i + 1 < argc) {
+            n_lookups = atol(argv[i+1]);
+            i += 1;
+        }
+        else if(strcmp(argv[i], "--searches") == 0 && i + 1 < argc) {
+            n_searches = atol(argv[i+1]);
+            i += 1;
+        }
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[i+1]);
+            i += 1;
+        }
+        else if(strcmp(argv[i], "--build") == 0 && i + 1 < argc) {
+            build = argv[i+1];
+            i += 1;
+        }
+        else {
+            usage();
+        }
+    }
+    if(n_lookups < 1 || n_searches < 1 || max_threads < 1) {
+        usage();
+    }
+
+    printf("{\n  \"build\": \"%s\",\n", build);
+
+    if(split_path) {
+        char command[1024];
+        snprintf(command, sizeof(command), "%s %s --stats > split.log 2> split.stats",
+                 split_path, dump_path);
+
+        const double start = monotonic_seconds();
+        if(system(command) != 0) {
+            fail(RETURN_BADFILE, "quelt-split failed; see split.log");
+        }
+        const double elapsed = monotonic_seconds() - start;
+        const long long dump_bytes = file_size(dump_path);
+
+        char stats[8192] = {0};
+        FILE* stats_file = fopen("split.stats", "r");
+        if(stats_file) {
+            // The counters come last, after any progress lines
+            if(fseek(stats_file, -(long)(sizeof(stats) - 1), SEEK_END) != 0) {
+                rewind(stats_file);
+            }
+            fread(stats, 1, sizeof(stats) - 1, stats_file);
+            fclose(stats_file);
+        }
+
+        printf("  \"split\": {\"dump_bytes\": %lld, \"seconds\": %.3f, \"mb_per_second\": %.1f, "
+               "\"sort_seconds\": %.3f, \"merge_seconds\": %.3f},\n",
+               dump_bytes, elapsed, dump_bytes / (1024.0*1024.0) / elapsed,
+               split_stat(stats, "sort_seconds"), split_stat(stats, "merge_seconds"));
+    }
+
+    printf("  \"size\": {\"quelt.db\": %lld, \"quelt.index\": %lld, \"quelt.trigram\": %lld, "
+           "\"quelt.mph\": %lld},\n", file_size("quelt.db"), file_size("quelt.index"),
+           file_size("quelt.trigram"), file_size("quelt.mph"));
+
+    const double open_start = monotonic_seconds();
+    QueltDB* db = queltdb_open();
+    if(!db) {
+        fail(RETURN_BADFILE, "Could not open database");
+    }
+    const double open_seconds = monotonic_seconds() - open_start;
+
+    TitleList list = {NULL, 0, 0};
+    queltdb_search(db, "", collect_title, &list);
+    if(list.n_titles == 0) {
+        fail(RETURN_BADFILE, "Database is empty");
+    }
+    printf("  \"titles\": %zu,\n  \"open_us\": %.1f,\n", list.n_titles, open_seconds * 1e6);
+
+    // Uniformly random titles, a small hot set, and titles that are missing
+    // but sort among the real ones
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    char** random_titles = malloc(n_lookups * sizeof(char*));
+    char** hot_titles = malloc(n_lookups * sizeof(char*));
+    char** missing_titles = malloc(n_lookups * sizeof(char*));
+    char* missing_buf = malloc(n_lookups * (MAX_TITLE_LEN+2));
+    char* hot_set[HOT_TITLES];
+    if(!random_titles || !hot_titles || !missing_titles || !missing_buf) {
+        fail(RETURN_BADFILE, "Out of memory");
+    }
+
+    for(size_t i = 0; i < HOT_TITLES; i += 1) {
+        hot_set[i] = list.titles[next_random(&state) % list.n_titles];
+    }
+    for(size_t i = 0; i < n_lookups; i += 1) {
+        random_titles[i] = list.titles[next_random(&state) % list.n_titles];
+        hot_titles[i] = hot_set[next_random(&state) % HOT_TITLES];
+        missing_titles[i] = missing_buf + i*(MAX_TITLE_LEN+2);
+        snprintf(missing_titles[i], MAX_TITLE_LEN+1, "%s~",
+                 list.titles[next_random(&state) % list.n_titles]);
+    }
+
+    printf("  \"getarticle\": {\n");
+    bench_lookups(db, "random", random_titles, n_lookups, false);
+    bench_lookups(db, "hot", hot_titles, n_lookups, false);
+    bench_lookups(db, "missing", missing_titles, n_lookups, true);
+    printf("  },\n");
+
+    printf("  \"search\": {\n");
+    bench_searches(db, &list, n_searches, 0, &state, "exact", false);
+    bench_searches(db, &list, n_searches, QUELTDB_SEARCH_ICASE, &state, "icase", true);
+    printf("  },\n");
+
+    // The random lookups again, shared out between 1, 2, 4... threads
+    printf("  \"threaded_getarticle\": {\n");
+    for(int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+        bench_threads(db, random_titles, n_lookups, n_threads, n_threads*2 > max_threads);
+    }
+    printf("  },\n");
+    queltdb_close(db);
+
+    // The same lookups with the perfect hash moved aside, leaving the binary
+    // search of the sorted index.  Missing titles are never inflated, so
+    // they time the index alone.
+    printf("  \"binary_search\": {\n");
+    if(rename("quelt.mph", "quelt.mph.off") == 0) {
+        db = queltdb_open();
+        if(!db) {
+            rename("quelt.mph.off", "quelt.mph");
+            fail(RETURN_BADFILE, "Could not open database");
+        }
+        bench_lookups(db, "random", random_titles, n_lookups, false);
+        bench_lookups(db, "missing", missing_titles, n_lookups, true);
+        queltdb_close(db);
+        rename("quelt.mph.off", "quelt.mph");
+    }
+    printf("  }\n}\n");
+
+    for(size_t i = 0; i < list.n_titles; i += 1) {
+        free(list.titles[i]);
+    }
+    free(list.titles);
+    free(random_titles);
+    free(hot_titles);
+    free(missing_titles);
+    free(missing_buf);
+    return RETURN_OK;
+}
@@ -0,0 +1,240 @@
+// Copyright (c) 2011 Andrew Aldridge under the terms in the LICENSE file.
+
+// Writes a synthetic MediaWiki export to standard output for benchmarking.
+// The same options always give the same dump, byte for byte.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Article bodies never grow past this, whatever the size distribution says
+#define MAX_BODY_LEN (1024*1024)
+#define MIN_BODY_LEN 64
+
+static const char* const WORDS[] = {
+    "river", "church", "album", "school", "station", "village", "county",
+    "football", "history", "railway", "island", "mountain", "district",
+    "election", "season", "battle", "castle", "language", "province", "bridge",
+    "university", "museum", "airport", "valley", "harbour", "temple", "novel",
+    "film", "band", "species", "genus", "family", "order", "empire", "king",
+    "queen", "war", "treaty", "census", "population", "north", "south", "east",
+    "west", "old", "new", "great", "little", "upper", "lower", "saint", "lake",
+    "forest", "park", "street", "road", "tower", "hall", "house", "court",
+    "the", "of", "and", "in", "was", "is", "a", "to", "for", "by", "with",
+    "from", "on", "as", "which", "after", "first", "its", "also", "into",
+    "between", "during", "under", "known", "built", "located", "named",
+    "founded", "released", "played", "born", "died", "married", "served"
+};
+#define N_WORDS (sizeof(WORDS)/sizeof(WORDS[0]))
+// The first words make for better titles than "the" or "of"
+#define N_TITLE_WORDS 60
+
+static const char* const TEMPLATES[] = {
+    "Infobox settlement", "Infobox person", "Infobox album", "Infobox river",
+    "Infobox school", "Infobox football club", "Taxobox", "Infobox station"
+};
+#define N_TEMPLATES (sizeof(TEMPLATES)/sizeof(TEMPLATES[0]))
+
+typedef struct {
+    long n_articles;
+    uint64_t seed;
+    // Bodies follow a log-normal distribution with this median and sigma
+    long median_size;
+    double sigma;
+    // Percentages of pages that are redirects, and of articles opening with
+    // an infobox template
+    int redirect_percent;
+    int template_percent;
+} GenOptions;
+
+// splitmix64: small, fast, and identical everywhere
+static uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double random_unit(uint64_t* state) {
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t page_seed(const GenOptions* options, long page) {
+    uint64_t state = options->seed ^ ((uint64_t)page * 0xd1b54a32d192ed03ULL);
+    return next_random(&state);
+}
+
+// Write the title of the given page.  Titles are a function of the page
+// number alone, so redirects and links can name any page.
+static void page_title(const GenOptions* options, long page, char* title, size_t len) {
+    uint64_t state = page_seed(options, page) ^ 0x5851f42d4c957f2dULL;
+    const char* first = WORDS[next_random(&state) % N_TITLE_WORDS];
+    const char* second = WORDS[next_random(&state) % N_TITLE_WORDS];
+    snprintf(title, len, "%c%s %s %ld", first[0] - 'a' + 'A', first + 1, second, page);
+}
+
+// Whether the given page is a redirect
+static bool page_is_redirect(const GenOptions* options, long page) {
+    uint64_t state = page_seed(options, page) ^ 0x2545f4914f6cdd1dULL;
+    return (long)(next_random(&state) % 100) < options->redirect_percent;
+}
+
+// Appends text to a body until the next piece would not fit.  Pieces are
+// never cut short, so entities stay whole.
+typedef struct {
+    char* buf;
+    size_t len;
+    size_t cap;
+} Body;
+
+static void body_append(Body* body, const char* s) {
+    const size_t len = strlen(s);
+    if(len > body->cap - body->len) {
+        body->cap = body->len;
+        return;
+    }
+
+    memcpy(body->buf + body->len, s, len);
+    body->len += len;
+}
+
+static void write_article(const GenOptions* options, long page, uint64_t* state, Body* body) {
+    // Box-Muller gives a normally distributed exponent
+    const double u1 = random_unit(state) + 1e-12;
+    const double u2 = random_unit(state);
+    const double normal = sqrt(-2.0 * log(u1)) * cos(2.0 * 3.14159265358979 * u2);
+    double target = options->median_size * exp(options->sigma * normal);
+    if(target < MIN_BODY_LEN) target = MIN_BODY_LEN;
+    if(target > MAX_BODY_LEN) target = MAX_BODY_LEN;
+    body->cap = (size_t)target;
+    body->len = 0;
+
+    char buf[512];
+    char title[256];
+    if((long)(next_random(state) % 100) < options->template_percent) {
+        snprintf(buf, sizeof(buf), "{{%s\n| name = %s\n| established = %d\n| area_km2 = %d\n}}\n",
+                 TEMPLATES[next_random(state) % N_TEMPLATES],
+                 WORDS[next_random(state) % N_TITLE_WORDS],
+                 1000 + (int)(next_random(state) % 1000), (int)(next_random(state) % 10000));
+        body_append(body, buf);
+    }
+
+    // Sentences of words, with the odd link, reference, and section heading
+    size_t next_heading = 1500;
+    bool sentence_start = true;
+    while(body->len < body->cap) {
+        const uint64_t r = next_random(state) % 100;
+        if(body->len >= next_heading) {
+            snprintf(buf, sizeof(buf), "\n\n== %s ==\n", WORDS[next_random(state) % N_TITLE_WORDS]);
+            next_heading += 1500;
+            sentence_start = true;
+        }
+        else if(r < 4) {
+            page_title(options, next_random(state) % options->n_articles, title, sizeof(title));
+            snprintf(buf, sizeof(buf), " [[%s]]", title);
+        }
+        else if(r < 5) {
+            snprintf(buf, sizeof(buf), "&lt;ref&gt;{{cite web |title=%s |year=%d}}&lt;/ref&gt;",
+                     WORDS[next_random(state) % N_WORDS], 1900 + (int)(next_random(state) % 120));
+        }
+        else if(r < 12) {
+            snprintf(buf, sizeof(buf), ".");
+            sentence_start = true;
+        }
+        else {
+            const char* word = WORDS[next_random(state) % N_WORDS];
+            if(sentence_start) {
+                snprintf(buf, sizeof(buf), " %c%s", word[0] - 'a' + 'A', word + 1);
+                sentence_start = false;
+            }
+            else {
+                snprintf(buf, sizeof(buf), " %s", word);
+            }
+        }
+        body_append(body, buf);
+    }
+
+    snprintf(buf, sizeof(buf), "\n\n[[Category:%s]]", WORDS[page % N_TITLE_WORDS]);
+    body->cap += sizeof(buf);
+    body_append(body, buf);
+}
+
+static void write_page(const GenOptions* options, long page, Body* body) {
+    uint64_t state = page_seed(options, page);
+    char title[256];
+    page_title(options, page, title, sizeof(title));
+
+    if(page_is_redirect(options, page)) {
+        char target[256];
+        page_title(options, next_random(&state) % options->n_articles, target, sizeof(target));
+        body->len = (size_t)snprintf(body->buf, MAX_BODY_LEN, "#REDIRECT [[%s]]", target);
+    }
+    else {
+        write_article(options, page, &state, body);
+    }
+
+    printf("  <page>\n"
+           "    <title>%s</title>\n"
+           "    <ns>0</ns>\n"
+           "    <id>%ld</id>\n"
+           "    <revision>\n"
+           "      <id>%ld</id>\n"
+           "      <timestamp>2011-01-01T00:00:00Z</timestamp>\n"
+           "      <text xml:space=\"preserve\">", title, page + 1, page + 1);
+    fwrite(body->buf, 1, body->len, stdout);
+    printf("</text>\n"
+           "    </revision>\n"
+           "  </page>\n");
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: gendump [--articles N] [--seed N] [--median-size BYTES] [--sigma X]\n"
+                    "               [--redirects PERCENT] [--templates PERCENT]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    GenOptions options = {20000, 1, 2000, 1.2, 30, 40};
+
+    for(int i = 1; i < argc; i += 1) {
+        if(i + 1 >= argc) {
+            usage();
+        }
+
+        const char* value = argv[i+1];
+        if(strcmp(argv[i], "--articles") == 0) options.n_articles = atol(value);
+        else if(strcmp(argv[i], "--seed") == 0) options.seed = strtoull(value, NULL, 10);
+        else if(strcmp(argv[i], "--median-size") == 0) options.median_size = atol(value);
+        else if(strcmp(argv[i], "--sigma") == 0) options.sigma = atof(value);
+        else if(strcmp(argv[i], "--redirects") == 0) options.redirect_percent = atoi(value);
+        else if(strcmp(argv[i], "--templates") == 0) options.template_percent = atoi(value);
+        else usage();
+        i += 1;
+    }
+
+    if(options.n_articles < 1 || options.median_size < 1 || options.sigma < 0) {
+        usage();
+    }
+
+    Body body;
+    body.buf = malloc(MAX_BODY_LEN + 512);
+    body.cap = MAX_BODY_LEN;
+    if(!body.buf) {
+        return 1;
+    }
+
+    printf("<mediawiki xmlns=\"http://www.mediawiki.org/xml/export-0.5/\" version=\"0.5\" xml:lang=\"en\">\n"
+           "  <siteinfo>\n"
+           "    <sitename>Quelt benchmark</sitename>\n"
+           "  </siteinfo>\n");
+    for(long page = 0; page < options.n_articles; page += 1) {
+        write_page(&options, page, &body);
+    }
+    printf("</mediawiki>\n");
+
+    free(body.buf);
+    return 0;
+}